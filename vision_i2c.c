@@ -12,6 +12,7 @@
 /*                                                                             */
 /*    Revisions:                                                               */
 /*                V1.00     6 April 2019 - Initial release                     */
+/*                V1.01    18 Oct 2026   - Add filtered object query           */
 /*                                                                             */
 /*-----------------------------------------------------------------------------*/
 /*                                                                             */
@@ -52,6 +53,10 @@
 #define   VISION_SIGNATURE_REG      0xAF
 #define   VISION_MAX_OBJECTS        4
 #define   VISION_OBJECTS_DATA_SIZE  6
+#define   VISION_MAX_ROIS           4
+
+#define   VISION_IMAGE_WIDTH        316
+#define   VISION_IMAGE_HEIGHT       212
 
 #define   VISION_BRIGHTNESS_REG     0xE2
 #define   VISION_WB_MODE_REG        0xE3
@@ -72,6 +77,9 @@ typedef struct _visionObject {
     short   height;
     short   angle;
     short   total;
+    short   centerX;
+    short   centerY;
+    long    area;
 } visionObject;
 
 typedef struct _visionSignatue {
@@ -108,6 +116,76 @@ typedef enum _visionLedMode {
     kVisionLedModeManual  = 1
 } visionLedMode;
 
+// Sort order for filtered object queries
+typedef enum _visionSortKey {
+    kVisionSortNone       = 0,    // sensor order
+    kVisionSortArea       = 1,    // largest first
+    kVisionSortCenter     = 2,    // closest to image centre first
+    kVisionSortY          = 3     // smallest y (top of image) first
+} visionSortKey;
+
+// Region of interest, inclusive, in image coordinates
+typedef struct _visionRoi {
+    short   left;
+    short   top;
+    short   right;
+    short   bottom;
+} visionRoi;
+
+// Filter used by visionObjectQuery
+// an object passes if its centre is inside any roi (or nRoi is 0),
+// it is at least minWidth x minHeight and its aspect ratio, as
+// width * 100 / height, is within aspectMin to aspectMax.
+// A value of 0 for any limit disables that check.
+typedef struct _visionQuery {
+    visionRoi     roi[VISION_MAX_ROIS];
+    short         nRoi;
+    short         minWidth;
+    short         minHeight;
+    short         aspectMin;
+    short         aspectMax;
+    visionSortKey sortKey;
+} visionQuery;
+
+/*-----------------------------------------------------------------------------*/
+/** @brief  Decode one object from the raw sensor data                         */
+/*-----------------------------------------------------------------------------*/
+void
+visionObjectDecode( char *buf, int id, visionObject *pObj ) {
+    pObj->id      = id;
+    pObj->x       = buf[0] * 2;
+    pObj->y       = buf[1];
+    pObj->width   = buf[2] * 2;
+    pObj->height  = buf[3];
+    pObj->angle   = buf[4] + (buf[5] << 8);
+
+    pObj->centerX = pObj->x + pObj->width  / 2;
+    pObj->centerY = pObj->y + pObj->height / 2;
+    pObj->area    = (long)pObj->width * pObj->height;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief  Request and read all objects for a signature                       */
+/** @returns the number of bytes read into buffer                              */
+/*-----------------------------------------------------------------------------*/
+int
+visionObjectRead( portName port, int id, char *buffer, int len ) {
+    // did we need to set msb ??
+    buffer[0] =  id       & 0xFF;
+    buffer[1] = (id >> 8) & 0xFF;
+
+    // ask for object
+    genericI2cWrite( port, VISION_ID_REG, buffer, 2 );
+
+    // max data to read
+    int  nData = len * VISION_OBJECTS_DATA_SIZE;
+
+    // now read answer
+    genericI2cRead( port, VISION_DATA_REG, &buffer[0], nData );
+
+    return( nData );
+}
+
 /*-----------------------------------------------------------------------------*/
 /** @brief  Read objects from the vision sensor                                */
 /** @param[in] port the port number on the IQ to use                           */
@@ -130,19 +208,7 @@ visionObjectGet( portName port, int id, visionObject *pObject, int len ) {
     if( len > VISION_MAX_OBJECTS )
       len = VISION_MAX_OBJECTS;
 
-    // did we need to set msb ??
-    buffer[0] =  id       & 0xFF;
-    buffer[1] = (id >> 8) & 0xFF;
-
-    // ask for object
-    genericI2cWrite( port, VISION_ID_REG, buffer, 2 );
-
-    // max data to read
-    int  nData = len * VISION_OBJECTS_DATA_SIZE;
-
-    // now read answer
-    // try and read 4 objects
-    genericI2cRead( port, VISION_DATA_REG, &buffer[0], nData );
+    visionObjectRead( port, id, buffer, len );
 
     // total objects
     int total = 0;
@@ -159,12 +225,7 @@ visionObjectGet( portName port, int id, visionObject *pObject, int len ) {
         break;
 
       // copy data
-      pObj->id     = id;
-      pObj->x      = buffer[ offset + 0 ] * 2;
-      pObj->y      = buffer[ offset + 1 ];
-      pObj->width  = buffer[ offset + 2 ] * 2;
-      pObj->height = buffer[ offset + 3 ];
-      pObj->angle  = buffer[ offset + 4 ] + (buffer[ offset + 5 ] << 8);
+      visionObjectDecode( &buffer[offset], id, pObj );
 
       // nect object
       total++;
@@ -175,6 +236,125 @@ visionObjectGet( portName port, int id, visionObject *pObject, int len ) {
     return( total );
 }
 
+/*-----------------------------------------------------------------------------*/
+/** @brief  Check an object against the query filter                           */
+/*-----------------------------------------------------------------------------*/
+bool
+visionObjectAccept( visionObject *pObj, visionQuery *pQuery ) {
+    if( pQuery->minWidth > 0 && pObj->width < pQuery->minWidth )
+      return(false);
+    if( pQuery->minHeight > 0 && pObj->height < pQuery->minHeight )
+      return(false);
+
+    // aspect ratio as percent, cross multiply to avoid the divide
+    long  w = (long)pObj->width * 100;
+    if( pQuery->aspectMin > 0 && w < (long)pQuery->aspectMin * pObj->height )
+      return(false);
+    if( pQuery->aspectMax > 0 && w > (long)pQuery->aspectMax * pObj->height )
+      return(false);
+
+    // no roi means the whole image
+    if( pQuery->nRoi <= 0 )
+      return(true);
+
+    for(int i=0;i<pQuery->nRoi && i<VISION_MAX_ROIS;i++) {
+      visionRoi *pRoi = &pQuery->roi[i];
+      if( pObj->centerX >= pRoi->left && pObj->centerX <= pRoi->right &&
+          pObj->centerY >= pRoi->top  && pObj->centerY <= pRoi->bottom )
+        return(true);
+    }
+
+    return(false);
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief  Sort rank of an object, lower ranks are returned first             */
+/*-----------------------------------------------------------------------------*/
+long
+visionObjectRank( visionObject *pObj, visionSortKey key ) {
+    long dx, dy;
+
+    switch( key ) {
+      case kVisionSortArea:
+        return( -pObj->area );
+      case kVisionSortCenter:
+        // squared distance is good enough for ordering
+        dx = pObj->centerX - VISION_IMAGE_WIDTH  / 2;
+        dy = pObj->centerY - VISION_IMAGE_HEIGHT / 2;
+        return( dx*dx + dy*dy );
+      case kVisionSortY:
+        return( pObj->y );
+      default:
+        break;
+    }
+    return(0);
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief  Read filtered and sorted objects from the vision sensor            */
+/** @param[in] port the port number on the IQ to use                           */
+/** @param[in] id the signature id to request                                  */
+/** @param[in] pQuery pointer to the filter and sort options                   */
+/** @param[in] pObject pointer to vision object array for the results          */
+/** @param[in] len max objects to return - limit 4                             */
+/** @returns the number of objects stored in pObject                           */
+/*-----------------------------------------------------------------------------*/
+//
+// All objects are read from the sensor, rejected objects are dropped as they
+// are decoded and survivors are insertion sorted straight into pObject, only
+// the best len are kept.
+//
+int
+visionObjectQuery( portName port, int id, visionQuery *pQuery, visionObject *pObject, int len ) {
+    char          buffer[VISION_MAX_OBJECTS * VISION_OBJECTS_DATA_SIZE];
+    visionObject  obj;
+
+    if( id <= 0 || len <= 0 )
+      return(0);
+
+    // limit to VISION_MAX_OBJECTS
+    if( len > VISION_MAX_OBJECTS )
+      len = VISION_MAX_OBJECTS;
+
+    // always read everything, the filter may reject some
+    visionObjectRead( port, id, buffer, VISION_MAX_OBJECTS );
+
+    int total = 0;
+
+    for(int i=0;i<VISION_MAX_OBJECTS;i++ ) {
+      int offset = i*6;
+
+      // object id of 0xFF means no more objects
+      if( buffer[offset] == 0xFF )
+        break;
+
+      visionObjectDecode( &buffer[offset], id, &obj );
+
+      if( !visionObjectAccept( &obj, pQuery ) )
+        continue;
+
+      // find insert position, equal ranks keep sensor order
+      long  rank = visionObjectRank( &obj, pQuery->sortKey );
+      int   pos  = total;
+      while( pos > 0 && visionObjectRank( &pObject[pos-1], pQuery->sortKey ) > rank )
+        pos--;
+
+      // worse than everything we already have
+      if( pos >= len )
+        continue;
+
+      // shift down, dropping the last one if full
+      if( total < len )
+        total++;
+      for(int j=total-1;j>pos;j--)
+        memcpy( &pObject[j], &pObject[j-1], sizeof(visionObject) );
+
+      memcpy( &pObject[pos], &obj, sizeof(visionObject) );
+    }
+
+    return( total );
+}
+
 //
 // Helper functions
 void